@@ -4,7 +4,7 @@
 namespace littlelog
 {
 
-        Buffer::Buffer():buffer(static_cast<Item*>(std::malloc(sz*sizeof(Item))))
+        Buffer::Buffer():next(nullptr),buffer(static_cast<Item*>(std::malloc(sz*sizeof(Item))))
         {
             for(int i=0;i<=sz;i++)
             {
@@ -22,6 +22,20 @@ namespace littlelog
             std::free(buffer);
         }
 
+        void Buffer::reset()
+        {
+            unsigned int write_count=write_state[sz].load(std::memory_order_acquire);
+            for(int i=0;i<write_count;i++)
+            {
+                buffer[i].~Item();
+            }
+            for(int i=0;i<=sz;i++)
+            {
+                write_state[i].store(0,std::memory_order_relaxed);
+            }
+            next.store(nullptr,std::memory_order_relaxed);
+        }
+
         bool Buffer::push(LogLine&& lg,const unsigned int new_idx)
         {
             new (&buffer[new_idx]) Item(std::move(lg));
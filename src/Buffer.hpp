@@ -30,8 +30,14 @@ namespace littlelog
 
         bool try_pop(LogLine& lg,const unsigned int read_idx);
 
+        //析构已写入的日志并清空状态，使读完的缓冲区可以重新使用
+        void reset();
+
         Buffer(const Buffer&)=delete;
         Buffer& operator=(const Buffer&)=delete;
+
+        //QueueBuffer中的下一个缓冲区，由写满本缓冲区的生产者设置，后台线程读完本缓冲区后沿其前进
+        std::atomic<Buffer*> next;
     private:
         Item* buffer;
         std::atomic<unsigned int> write_state[sz+1];
@@ -0,0 +1,70 @@
+#include "FlightRecorder.hpp"
+
+namespace littlelog
+{
+    //每条记录为4字节长度加编码；长度为0表示环尾剩余空间被跳过
+    static constexpr const size_t record_header=sizeof(uint32_t);
+
+    FlightRecorder::FlightRecorder(size_t capacity):buffer(new char[capacity]),capacity(capacity)
+    {
+    }
+
+    void FlightRecorder::push(const LogLine& lg)
+    {
+        size_t length;
+        const char* b=lg.encoded(length);
+        const size_t need=record_header+length;
+        //超过一半容量的记录可能在跳过环尾后仍放不下，直接丢弃
+        if(need>capacity/2)return;
+
+        size_t offset=tail%capacity;
+        size_t skip=offset+need>capacity?capacity-offset:0;
+        while(head<tail&&tail+skip+need-head>capacity)
+            pop_oldest();
+        if(head==tail&&skip)
+        {
+            //环已清空，直接从环头开始写
+            tail+=skip;
+            head=tail;
+            skip=0;
+            offset=0;
+        }
+        if(skip)
+        {
+            if(skip>=record_header)
+                memset(&buffer[offset],0,record_header);
+            tail+=skip;
+            offset=0;
+        }
+        uint32_t n=static_cast<uint32_t>(length);
+        memcpy(&buffer[offset],&n,record_header);
+        memcpy(&buffer[offset+record_header],b,length);
+        tail+=need;
+    }
+
+    void FlightRecorder::pop_oldest()
+    {
+        size_t offset=head%capacity;
+        uint32_t n=0;
+        if(capacity-offset>=record_header)
+            memcpy(&n,&buffer[offset],record_header);
+        head+=n?record_header+n:capacity-offset;
+    }
+
+    void FlightRecorder::dump(write_to_file& writer)
+    {
+        while(head<tail)
+        {
+            size_t offset=head%capacity;
+            uint32_t n=0;
+            if(capacity-offset>=record_header)
+                memcpy(&n,&buffer[offset],record_header);
+            if(n)
+            {
+                LogLine lg=LogLine::from_encoded(&buffer[offset+record_header],n);
+                writer.write(lg);
+            }
+            pop_oldest();
+        }
+    }
+}
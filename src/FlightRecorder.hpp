@@ -0,0 +1,38 @@
+#ifndef __FLIGHTRECORDER_HPP__
+#define __FLIGHTRECORDER_HPP__
+
+#include <memory>
+#include "LittleLog.hpp"
+#include "Write_to_file.hpp"
+
+namespace littlelog
+{
+    /**
+     * @brief 飞行记录器，只由后台线程访问：在固定大小的内存环中按到达顺序保存日志的原始编码，
+     *        空间不足时丢弃最早的日志；dump时才重建LogLine并格式化写入文件
+     * 
+     */
+    class FlightRecorder
+    {
+    public:
+        explicit FlightRecorder(size_t capacity);
+
+        void push(const LogLine& lg);
+
+        //按时间顺序写出所有保存的日志并清空
+        void dump(write_to_file& writer);
+
+        FlightRecorder(const FlightRecorder&)=delete;
+        FlightRecorder& operator=(const FlightRecorder&)=delete;
+    private:
+        void pop_oldest();
+
+        std::unique_ptr<char[]> buffer;
+        const size_t capacity;
+        //head为最早一条日志的位置，tail为下一次写入的位置，均单调递增
+        uint64_t head=0;
+        uint64_t tail=0;
+    };
+}
+
+#endif
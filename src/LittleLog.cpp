@@ -1,5 +1,4 @@
 #include "LittleLog.hpp"
-#include "SpinLock.hpp"
 #include <thread>
 #include <cstring>
 #include <string>
@@ -8,11 +7,43 @@
 #include <atomic>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <limits>
+#include <signal.h>
 #include "LittleLogger.hpp"
+#include "SharedLogger.hpp"
 
 namespace littlelog
 {
-    typedef std::tuple<char,char*,uint32_t,uint64_t,int32_t,int64_t,double,littlelog::LogLine::string_literal_t> SupportedTypes;
+    typedef std::tuple<char,char*,uint32_t,uint64_t,int32_t,int64_t,double,littlelog::LogLine::string_literal_t,littlelog::LogLine::codec_t,littlelog::LogLine::span_t> SupportedTypes;
+
+    struct CodecEntry
+    {
+        codec_format_t format;
+        uint32_t size;
+    };
+
+    static constexpr const size_t max_codecs=static_cast<size_t>(std::numeric_limits<codec_id_t>::max())+1;
+    static CodecEntry codecs[max_codecs];
+    static std::atomic<uint32_t> codec_count(0);
+
+    /**
+     * @brief 每个类型只在第一次使用时注册一次；后台线程通过Buffer的release/acquire同步看到注册结果。
+     *        表满后计数不再增加，之后的每次注册都失败，不会得到回绕的编号
+     * 
+     */
+    codec_id_t register_codec(codec_format_t format,uint32_t size)
+    {
+        uint32_t id=codec_count.load(std::memory_order_relaxed);
+        do
+        {
+            if(id>=max_codecs)
+                throw std::length_error("littlelog: too many codecs registered");
+        }while(!codec_count.compare_exchange_weak(id,id+1,std::memory_order_relaxed));
+        codecs[id]=CodecEntry{format,size};
+        return static_cast<codec_id_t>(id);
+    }
 
     uint64_t timestamp()
     {
@@ -30,6 +61,44 @@ namespace littlelog
         return !heap_buffer?&stack_buffer[bytes_used]:&(heap_buffer.get())[bytes_used];
     }
 
+    const char* LogLine::data() const
+    {
+        return !heap_buffer?stack_buffer:heap_buffer.get();
+    }
+
+    uint64_t LogLine::time() const
+    {
+        return *reinterpret_cast<const uint64_t*>(data());
+    }
+
+    LogLevel LogLine::level() const
+    {
+        return *reinterpret_cast<const LogLevel*>(data()+sizeof(uint64_t)+sizeof(std::thread::id)
+                +2*sizeof(string_literal_t)+sizeof(uint32_t));
+    }
+
+    std::thread::id LogLine::thread_id() const
+    {
+        return *reinterpret_cast<const std::thread::id*>(data()+sizeof(uint64_t));
+    }
+
+    const char* LogLine::file() const
+    {
+        return reinterpret_cast<const string_literal_t*>(data()+sizeof(uint64_t)+sizeof(std::thread::id))->s;
+    }
+
+    const char* LogLine::function() const
+    {
+        return reinterpret_cast<const string_literal_t*>(data()+sizeof(uint64_t)+sizeof(std::thread::id)
+                +sizeof(string_literal_t))->s;
+    }
+
+    uint32_t LogLine::line() const
+    {
+        return *reinterpret_cast<const uint32_t*>(data()+sizeof(uint64_t)+sizeof(std::thread::id)
+                +2*sizeof(string_literal_t));
+    }
+
     void LogLine::resize_buffer(size_t length)
     {
         if(bytes_used+length<buffer_size)return;
@@ -76,6 +145,15 @@ namespace littlelog
         bytes_used+=length+2;
     }
 
+    void LogLine::encode_codec(codec_id_t id,const void* arg,size_t length)
+    {
+        resize_buffer(1+sizeof(id)+length);
+        encode<uint8_t>(static_cast<uint8_t>(TupleIndex<codec_t,SupportedTypes>::value));
+        encode<codec_id_t>(id);
+        memcpy(get_index(),arg,length);
+        bytes_used+=length;
+    }
+
     void LogLine::encode(char* arg)
     {
         if(arg!=nullptr)encode_c_string(arg,strlen(arg));
@@ -91,11 +169,181 @@ namespace littlelog
         encode<string_literal_t>(arg,TupleIndex<LogLine::string_literal_t,SupportedTypes>::value);
     }
 
+    /**
+     * @brief 参数(不含类型标记)占用的字节数
+     * 
+     * @param b :指向类型标记
+     */
+    static size_t arg_size(const char* b)
+    {
+        switch (static_cast<int>(*b))
+        {
+            case TupleIndex<char,SupportedTypes>::value:
+                return sizeof(char);
+            case TupleIndex<char*,SupportedTypes>::value:
+                return strlen(b+1)+1;
+            case TupleIndex<uint32_t,SupportedTypes>::value:
+                return sizeof(uint32_t);
+            case TupleIndex<uint64_t,SupportedTypes>::value:
+                return sizeof(uint64_t);
+            case TupleIndex<int32_t,SupportedTypes>::value:
+                return sizeof(int32_t);
+            case TupleIndex<int64_t,SupportedTypes>::value:
+                return sizeof(int64_t);
+            case TupleIndex<double,SupportedTypes>::value:
+                return sizeof(double);
+            case TupleIndex<LogLine::string_literal_t,SupportedTypes>::value:
+                return sizeof(LogLine::string_literal_t);
+            case TupleIndex<LogLine::codec_t,SupportedTypes>::value:
+                return sizeof(codec_id_t)+codecs[*reinterpret_cast<const codec_id_t*>(b+1)].size;
+            case TupleIndex<LogLine::span_t,SupportedTypes>::value:
+                return sizeof(LogLine::span_t);
+        }
+        return 0;
+    }
+
+    static constexpr const size_t header_size=sizeof(uint64_t)+sizeof(std::thread::id)
+        +2*sizeof(LogLine::string_literal_t)+sizeof(uint32_t)+sizeof(LogLevel);
+
+    static const char* safe_string(const char* s)
+    {
+        return s?s:"";
+    }
+
+    const char* LogLine::payload(size_t& length) const
+    {
+        length=bytes_used-header_size;
+        return data()+header_size;
+    }
+
+    bool LogLine::get_span(span_t& span) const
+    {
+        const char* b=data()+header_size;
+        if(bytes_used<=header_size||*b!=TupleIndex<span_t,SupportedTypes>::value)return false;
+        memcpy(&span,b+1,sizeof(span));
+        return true;
+    }
+
+    static std::ostream& operator<<(std::ostream& os,const LogLine::span_t& span)
+    {
+        return os<<"scope "<<span.name<<' '<<span.end-span.begin<<"us";
+    }
+
+    /**
+     * @brief 自定义类型的格式化函数和区间名称只存在于本进程，写入共享内存前在生产者线程中格式化为字符串
+     * 
+     */
+    static bool is_local_arg(const char* b)
+    {
+        return *b==TupleIndex<LogLine::codec_t,SupportedTypes>::value||*b==TupleIndex<LogLine::span_t,SupportedTypes>::value;
+    }
+
+    static std::string format_local_arg(const char* b)
+    {
+        std::ostringstream os;
+        if(*b==TupleIndex<LogLine::span_t,SupportedTypes>::value)
+        {
+            LogLine::span_t span;
+            memcpy(&span,b+1,sizeof(span));
+            os<<span;
+            return os.str();
+        }
+        codec_id_t id=*reinterpret_cast<const codec_id_t*>(b+1);
+        codecs[id].format(os,b+1+sizeof(codec_id_t));
+        return os.str();
+    }
+
+    /**
+     * @brief 追加到out末尾，自定义类型和区间参数在这里格式化一次
+     * 
+     */
+    void LogLine::to_portable(std::string& out) const
+    {
+        const char* b=data();
+        const char* const end=b+bytes_used;
+        out.append(b,sizeof(uint64_t)+sizeof(std::thread::id));
+        b+=sizeof(uint64_t)+sizeof(std::thread::id);
+        for(int i=0;i<2;i++)
+        {
+            out.append(safe_string(reinterpret_cast<const string_literal_t*>(b)->s));
+            out.push_back('\0');
+            b+=sizeof(string_literal_t);
+        }
+        out.append(b,sizeof(uint32_t)+sizeof(LogLevel));
+        b+=sizeof(uint32_t)+sizeof(LogLevel);
+        for(;b<end;b+=1+arg_size(b))
+        {
+            if(*b==TupleIndex<string_literal_t,SupportedTypes>::value)
+            {
+                out.push_back(static_cast<char>(TupleIndex<char*,SupportedTypes>::value));
+                out.append(reinterpret_cast<const string_literal_t*>(b+1)->s);
+                out.push_back('\0');
+            }
+            else if(is_local_arg(b))
+            {
+                out.push_back(static_cast<char>(TupleIndex<char*,SupportedTypes>::value));
+                out.append(format_local_arg(b));
+                out.push_back('\0');
+            }
+            else
+                out.append(b,1+arg_size(b));
+        }
+    }
+
+    const char* LogLine::encoded(size_t& length) const
+    {
+        length=bytes_used;
+        return data();
+    }
+
+    LogLine LogLine::from_encoded(const char* in,size_t length)
+    {
+        LogLine lg(LogLevel::INFO,nullptr,nullptr,0);
+        lg.bytes_used=0;
+        lg.resize_buffer(length);
+        memcpy(lg.get_index(),in,length);
+        lg.bytes_used=length;
+        return lg;
+    }
+
+    LogLine LogLine::from_portable(const char* in,size_t length)
+    {
+        const char* const end=in+length;
+        const char* ids=in;
+        in+=sizeof(uint64_t)+sizeof(std::thread::id);
+        const char* file=in;
+        in+=strlen(file)+1;
+        const char* function=in;
+        in+=strlen(function)+1;
+        uint32_t line;
+        memcpy(&line,in,sizeof(line));
+        in+=sizeof(uint32_t);
+        LogLevel level=*reinterpret_cast<const LogLevel*>(in);
+        in+=sizeof(LogLevel);
+
+        //使用生产者进程中的时间戳和线程id
+        uint64_t time;
+        std::thread::id tid;
+        memcpy(&time,ids,sizeof(time));
+        memcpy(&tid,ids+sizeof(uint64_t),sizeof(tid));
+        LogLine lg(level,file,function,line,time,tid);
+        size_t n=end-in;
+        lg.resize_buffer(n);
+        memcpy(lg.get_index(),in,n);
+        lg.bytes_used+=n;
+        return lg;
+    }
+
     LogLine::LogLine(LogLevel level,const char* file,const char* function,uint32_t line)
+    :LogLine(level,file,function,line,timestamp(),this_thread_id())
+    {
+    }
+
+    LogLine::LogLine(LogLevel level,const char* file,const char* function,uint32_t line,uint64_t time,std::thread::id tid)
     :bytes_used(0),buffer_size(sizeof(stack_buffer))
     {
-        encode<uint64_t> (timestamp());
-        encode<std::thread::id> (this_thread_id());
+        encode<uint64_t> (time);
+        encode<std::thread::id> (tid);
         encode<string_literal_t> (string_literal_t(file));
         encode<string_literal_t> (string_literal_t(function));
         encode<uint32_t> (line);
@@ -230,6 +478,24 @@ namespace littlelog
         return b;
     }
 
+    template<>
+    char* decode(std::ostream& os,char* b,LogLine::codec_t* dummy)
+    {
+        codec_id_t id=*reinterpret_cast<codec_id_t*>(b);
+        b+=sizeof(codec_id_t);
+        codecs[id].format(os,b);
+        return b+codecs[id].size;
+    }
+
+    template<>
+    char* decode(std::ostream& os,char* b,LogLine::span_t* dummy)
+    {
+        LogLine::span_t span;
+        memcpy(&span,b,sizeof(span));
+        os<<span;
+        return b+sizeof(LogLine::span_t);
+    }
+
     template<>
     char* decode(std::ostream&os,char* b,char** dummy)
     {
@@ -279,6 +545,12 @@ namespace littlelog
             case 7:
                 stringify(os,decode(os,start,static_cast<std::tuple_element_t<7,SupportedTypes>*>(nullptr)),end);
                 return;
+            case 8:
+                stringify(os,decode(os,start,static_cast<std::tuple_element_t<8,SupportedTypes>*>(nullptr)),end);
+                return;
+            case 9:
+                stringify(os,decode(os,start,static_cast<std::tuple_element_t<9,SupportedTypes>*>(nullptr)),end);
+                return;
         }
     }
 
@@ -286,6 +558,8 @@ namespace littlelog
 
     std::unique_ptr<LittleLogger> littlelog;
     std::atomic<LittleLogger*> atomic_littlelog;
+    std::unique_ptr<SharedLogger> sharedlog;
+    std::atomic<SharedLogger*> atomic_sharedlog;
 
     /**
      * @brief 不同的线程通过此重载运算符向日志主线程中放入新的日志信息
@@ -296,10 +570,26 @@ namespace littlelog
      */
     bool Log::operator==(LogLine& lg)
     {
-        atomic_littlelog.load(std::memory_order_acquire)->add(std::move(lg));
+        if(SharedLogger* shared=atomic_sharedlog.load(std::memory_order_acquire))
+            shared->add(std::move(lg));
+        else
+            atomic_littlelog.load(std::memory_order_acquire)->add(std::move(lg));
         return true;
     }
 
+    Scope::Scope(LogLine::string_literal_t name,const char* file,const char* function,uint32_t line)
+    :name(name.s),file(file),function(function),line(line),begin(level_isvalid(LogLevel::INFO)?timestamp():0)
+    {
+    }
+
+    Scope::~Scope()
+    {
+        if(!begin)return;
+        LogLine lg(LogLevel::INFO,file,function,line);
+        lg.encode<LogLine::span_t>(LogLine::span_t{name,begin,lg.time()},TupleIndex<LogLine::span_t,SupportedTypes>::value);
+        Log()==lg;
+    }
+
     std::atomic<unsigned int> loglevel(0);
 
     void set_level(LogLevel lg)
@@ -312,13 +602,69 @@ namespace littlelog
         return static_cast<unsigned int>(lv)>=loglevel.load(std::memory_order_relaxed);
     }
 
+    void set_collapse_duplicates(uint32_t window_ms)
+    {
+        if(LittleLogger* logger=atomic_littlelog.load(std::memory_order_acquire))
+            logger->set_collapse_window(static_cast<uint64_t>(window_ms)*1000);
+    }
+
     void init(const std::string& directory,const std::string& file,uint32_t roll_size)
     {
+        update_coarse_clock();
         littlelog.reset(new LittleLogger(directory,file,roll_size));
         atomic_littlelog.store(littlelog.get(),std::memory_order_seq_cst);
     }
-}
 
+    //安装飞行记录器的信号处理函数之前应用程序设置的处理方式
+    static struct sigaction previous_actions[NSIG];
+    static bool fatal_handlers_installed=false;
+
+    /**
+     * @brief 写出飞行记录器后恢复原来的处理方式再重新发送信号，由应用程序的处理函数或默认动作接着处理
+     * 
+     */
+    static void on_fatal_signal(int sig)
+    {
+        if(LittleLogger* logger=atomic_littlelog.load(std::memory_order_acquire))
+            logger->dump_and_wait();
+        sigaction(sig,&previous_actions[sig],nullptr);
+        raise(sig);
+    }
+
+    void init_flight_recorder(const std::string& directory,const std::string& file,uint32_t roll_size,
+        uint32_t capacity,LogLevel trigger)
+    {
+        update_coarse_clock();
+        littlelog.reset(new LittleLogger(directory,file,roll_size,capacity,trigger));
+        atomic_littlelog.store(littlelog.get(),std::memory_order_seq_cst);
+
+        //多次调用时只安装一次，避免把自己的处理函数保存为原来的处理方式
+        if(fatal_handlers_installed)return;
+        fatal_handlers_installed=true;
+        struct sigaction sa;
+        memset(&sa,0,sizeof(sa));
+        sa.sa_handler=on_fatal_signal;
+        sigemptyset(&sa.sa_mask);
+        for(int sig:{SIGSEGV,SIGBUS,SIGFPE,SIGILL,SIGABRT})
+            sigaction(sig,&sa,&previous_actions[sig]);
+    }
 
+    void dump()
+    {
+        if(LittleLogger* logger=atomic_littlelog.load(std::memory_order_acquire))
+            logger->request_dump();
+    }
 
+    void init_trace(const std::string& path)
+    {
+        if(LittleLogger* logger=atomic_littlelog.load(std::memory_order_acquire))
+            logger->set_trace_file(path);
+    }
 
+    void init_shared(const std::string& name,uint32_t ring_size)
+    {
+        update_coarse_clock();
+        sharedlog.reset(new SharedLogger(name,ring_size));
+        atomic_sharedlog.store(sharedlog.get(),std::memory_order_seq_cst);
+    }
+}
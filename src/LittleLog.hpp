@@ -4,7 +4,11 @@
 #include <stdint.h>
 #include <string.h>
 #include <memory>
+#include <string>
 #include <iostream>
+#include <type_traits>
+#include <thread>
+#include "LogSite.hpp"
 
 namespace littlelog
 {
@@ -14,6 +18,41 @@ namespace littlelog
         INFO,WARN,DEBUG
     };
 
+    /**
+     * @brief 用户自定义类型的延迟格式化：特化codec<T>，令enabled为true并提供format函数，
+     *        或者对已有operator<<(std::ostream&,const T&)的类型使用LITTLELOG_CODEC(T)。
+     *        T必须是平凡可复制的，生产者线程只把对象memcpy进LogLine，由后台线程调用format格式化。
+     *        对象的填充字节也会被拷贝，合并重复日志时按字节比较参数，因此应值初始化(T{}或T x{})
+     *        或用显式的填充字段代替编译器插入的填充，否则相同的值可能不被合并
+     * 
+     */
+    template<typename T>
+    struct codec
+    {
+        static constexpr bool enabled=false;
+    };
+
+    typedef void (*codec_format_t)(std::ostream& os,const char* b);
+    typedef uint8_t codec_id_t;
+
+    //注册一个codec，返回写入LogLine的编号，codec_id_t的每个取值对应一个，用完后抛出std::length_error
+    codec_id_t register_codec(codec_format_t format,uint32_t size);
+
+    template<typename T>
+    void format_codec(std::ostream& os,const char* b)
+    {
+        typename std::aligned_storage<sizeof(T),alignof(T)>::type storage;
+        memcpy(&storage,b,sizeof(T));
+        codec<T>::format(os,*reinterpret_cast<const T*>(&storage));
+    }
+
+    template<typename T>
+    codec_id_t codec_id()
+    {
+        static const codec_id_t id=register_codec(&format_codec<T>,sizeof(T));
+        return id;
+    }
+
     /**
      * @brief 日志条目类
      * 
@@ -22,6 +61,8 @@ namespace littlelog
     {
     public:
         LogLine(LogLevel level,const char* file,const char* function,uint32_t line);
+        //使用给定的时间戳和线程id，而不是当前时间和当前线程
+        LogLine(LogLevel level,const char* file,const char* function,uint32_t line,uint64_t time,std::thread::id tid);
         ~LogLine();
 
         LogLine(LogLine &&)=default;
@@ -58,15 +99,63 @@ namespace littlelog
             return *this;
         }
 
+        template<typename Arg>
+        typename std::enable_if<codec<Arg>::enabled,LogLine&>::type
+        operator<<(Arg const& arg)
+        {
+            static_assert(std::is_trivially_copyable<Arg>::value,"codec types must be trivially copyable");
+            encode_codec(codec_id<Arg>(),&arg,sizeof(Arg));
+            return *this;
+        }
+
         struct string_literal_t
         {
             explicit string_literal_t(const char* s_):s(s_){}
             const char* s;
         };
 
+        struct codec_t
+        {
+            codec_id_t id;
+        };
+
+        //LOG_SCOPE记录的区间，begin和end为微秒时间戳
+        struct span_t
+        {
+            const char* name;
+            uint64_t begin;
+            uint64_t end;
+        };
+
         void stringify(std::ostream& os);
+
+        uint64_t time() const;
+        LogLevel level() const;
+        std::thread::id thread_id() const;
+        const char* file() const;
+        const char* function() const;
+        uint32_t line() const;
+        //日志头部之后的参数编码
+        const char* payload(size_t& length) const;
+        //由LOG_SCOPE产生的日志返回true并取出区间
+        bool get_span(span_t& span) const;
+
+        /**
+         * @brief 与进程地址空间无关的编码，字符串字面量被替换为字符串内容，供共享内存环形缓冲区使用
+         * 
+         */
+        void to_portable(std::string& out) const;
+        //in指向的内存在LogLine格式化之前必须保持有效(文件名和函数名直接引用该内存)
+        static LogLine from_portable(const char* in,size_t length);
+
+        //进程内的原始编码(字符串字面量仍为指针)，供飞行记录器暂存
+        const char* encoded(size_t& length) const;
+        static LogLine from_encoded(const char* in,size_t length);
     private:
+        friend class Scope;
+
         char* get_index();
+        const char* data() const;
 
         template<typename Arg>
         void encode(Arg arg)
@@ -87,6 +176,7 @@ namespace littlelog
         void encode(const char* arg);
         void encode(string_literal_t arg);
         void encode_c_string(const char* arg,size_t length);
+        void encode_codec(codec_id_t id,const void* arg,size_t length);
         void resize_buffer(size_t sz);
         
         void stringify(std::ostream& os,char* start,const char* end);
@@ -102,16 +192,100 @@ namespace littlelog
         bool operator==(LogLine &);
     };
 
+    /**
+     * @brief LOG_SCOPE使用的RAII对象，析构时把进入、退出时间戳作为一条INFO日志放入缓冲区
+     * 
+     */
+    class Scope
+    {
+    public:
+        template<size_t N>
+        Scope(const char(&name)[N],const char* file,const char* function,uint32_t line)
+        :Scope(LogLine::string_literal_t(name),file,function,line){}
+
+        ~Scope();
+
+        Scope(const Scope&)=delete;
+        Scope& operator=(const Scope&)=delete;
+    private:
+        Scope(LogLine::string_literal_t name,const char* file,const char* function,uint32_t line);
+
+        const char* name;
+        const char* file;
+        const char* function;
+        uint32_t line;
+        uint64_t begin;
+    };
+
     void set_level(LogLevel lg);
     bool level_isvalid(LogLevel lg);
 
+    /**
+     * @brief 后台合并重复日志：同一调用点参数完全相同的连续日志在window_ms毫秒内只写第一条，
+     *        之后写一条"last message repeated N times"，0表示关闭；须在init之后调用
+     * 
+     */
+    void set_collapse_duplicates(uint32_t window_ms);
+
     void init(const std::string& log_dir,const std::string& log_file,uint32_t roll_size);
+
+    /**
+     * @brief 进程外后端模式：日志写入名为name的共享内存环形缓冲区(ring_size MB)，
+     *        由littlelogd负责格式化和写文件
+     * 
+     */
+    void init_shared(const std::string& name,uint32_t ring_size);
+
+    /**
+     * @brief 飞行记录器模式：后台线程把最近capacity MB的日志以编码形式保存在内存环中，不格式化也不写盘；
+     *        收到trigger级别(默认WARN)的日志、调用dump()或进程收到致命信号时，才把环中的日志连同触发日志写入文件
+     * 
+     */
+    void init_flight_recorder(const std::string& log_dir,const std::string& log_file,uint32_t roll_size,
+        uint32_t capacity,LogLevel trigger=LogLevel::WARN);
+
+    //把飞行记录器中的日志写入文件，非飞行记录器模式下无作用
+    void dump();
+
+    /**
+     * @brief LOG_SCOPE产生的区间改为写入Chrome trace-event格式的JSON文件(可用chrome://tracing或
+     *        Perfetto打开)，不再写入文本日志；须在init之后调用，只能调用一次
+     * 
+     */
+    void init_trace(const std::string& path);
 }
 
 
+#define LITTLELOG_CODEC(TYPE) \
+    namespace littlelog{ \
+    template<> struct codec<TYPE> \
+    { \
+        static constexpr bool enabled=true; \
+        static void format(std::ostream& os,const TYPE& v){os<<v;} \
+    };}
+
+#define LITTLELOG_CONCAT_(A,B) A##B
+#define LITTLELOG_CONCAT(A,B) LITTLELOG_CONCAT_(A,B)
+
 #define LOG(LEVEL) littlelog::Log()==littlelog::LogLine(LEVEL,__FILE__,__func__,__LINE__)
 #define LOG_INFO littlelog::level_isvalid(littlelog::LogLevel::INFO) && LOG(littlelog::LogLevel::INFO)
 #define LOG_WARN littlelog::level_isvalid(littlelog::LogLevel::WARN) && LOG(littlelog::LogLevel::WARN)
 #define LOG_DEBUG littlelog::level_isvalid(littlelog::LogLevel::DEBUG) && LOG(littlelog::LogLevel::DEBUG)
 
+/**
+ * @brief 记录所在作用域的进入、退出时间和耗时，NAME必须是字符串字面量，例如 LOG_SCOPE("parse");
+ * 
+ */
+#define LOG_SCOPE(NAME) littlelog::Scope LITTLELOG_CONCAT(littlelog_scope_,__LINE__)(NAME,__FILE__,__func__,__LINE__)
+
+/**
+ * @brief 按调用点限流/采样的日志宏，LEVEL为INFO、WARN或DEBUG，例如 LOG_EVERY_N(INFO,100)<<i;
+ *        被抑制的日志不会构造LogLine，后台线程会周期性地报告每个调用点被抑制的条数
+ *
+ */
+#define LOG_EVERY_N(LEVEL,N) littlelog::level_isvalid(littlelog::LogLevel::LEVEL) && LITTLELOG_SITE().every_n(N) && LOG(littlelog::LogLevel::LEVEL)
+#define LOG_FIRST_N(LEVEL,N) littlelog::level_isvalid(littlelog::LogLevel::LEVEL) && LITTLELOG_SITE().first_n(N) && LOG(littlelog::LogLevel::LEVEL)
+#define LOG_EVERY_MS(LEVEL,MS) littlelog::level_isvalid(littlelog::LogLevel::LEVEL) && LITTLELOG_SITE().every_ms(MS) && LOG(littlelog::LogLevel::LEVEL)
+#define LOG_RATE_LIMITED(LEVEL,PER_SECOND,BURST) littlelog::level_isvalid(littlelog::LogLevel::LEVEL) && LITTLELOG_SITE().rate_limited(PER_SECOND,BURST) && LOG(littlelog::LogLevel::LEVEL)
+
 #endif
\ No newline at end of file
@@ -1,11 +1,15 @@
 #include "LittleLogger.hpp"
+#include <time.h>
 
 namespace littlelog
 {
-    LittleLogger::LittleLogger(const std::string& dir,const std::string& file,uint32_t roll_size):
-    state(State::INTI),log_buffer(new QueueBuffer()),writer(dir,file,roll_size),
-    read_thread(&LittleLogger::work,this)
+    LittleLogger::LittleLogger(const std::string& dir,const std::string& file,uint32_t roll_size,
+        uint32_t flight_capacity,LogLevel trigger):
+    state(State::INTI),log_buffer(new QueueBuffer()),writer(dir,file,roll_size),atomic_tracer(nullptr),
+    trigger_level(trigger),dump_requested(false),dumps_done(0),read_thread(&LittleLogger::work,this)
     {
+        if(flight_capacity)
+            recorder.reset(new FlightRecorder(static_cast<size_t>(flight_capacity)*1024*1024));
         state.store(State::READY,std::memory_order_release);
     }
 
@@ -15,6 +19,36 @@ namespace littlelog
         read_thread.join();
     }
 
+    void LittleLogger::set_collapse_window(uint64_t window_us)
+    {
+        writer.set_collapse_window(window_us);
+    }
+
+    void LittleLogger::set_trace_file(const std::string& path)
+    {
+        if(tracer)return;
+        tracer.reset(new write_to_trace(path));
+        atomic_tracer.store(tracer.get(),std::memory_order_release);
+    }
+
+    void LittleLogger::request_dump()
+    {
+        dump_requested.store(true,std::memory_order_release);
+    }
+
+    void LittleLogger::dump_and_wait()
+    {
+        if(!recorder||std::this_thread::get_id()==read_thread.get_id())
+            return;
+        uint64_t done=dumps_done.load(std::memory_order_acquire);
+        request_dump();
+        for(int i=0;i<2000&&dumps_done.load(std::memory_order_acquire)==done;i++)
+        {
+            struct timespec ts={0,1000000};
+            nanosleep(&ts,nullptr);
+        }
+    }
+
     void LittleLogger::add(LogLine&& lg)
     {
         log_buffer->push(std::move(lg));
@@ -25,16 +59,80 @@ namespace littlelog
         while(state.load(std::memory_order_acquire)==State::INTI)
             std::this_thread::sleep_for(std::chrono::microseconds(50));
         LogLine curLog(LogLevel::INFO,nullptr,nullptr,0);
+        uint64_t last_report=coarse_clock.load(std::memory_order_relaxed);
         while(state.load()==State::READY)
         {
+            update_coarse_clock();
+            if(coarse_clock.load(std::memory_order_relaxed)-last_report>=suppressed_report_interval)
+            {
+                report_suppressed();
+                last_report=coarse_clock.load(std::memory_order_relaxed);
+            }
+            if(dump_requested.load(std::memory_order_acquire))
+            {
+                //先把缓冲区中尚未处理的日志放入飞行记录器，再整体写出
+                dump_requested.store(false,std::memory_order_relaxed);
+                while(log_buffer->try_pop(curLog))
+                    write(curLog);
+                if(recorder)
+                    recorder->dump(writer);
+                dumps_done.fetch_add(1,std::memory_order_release);
+            }
             if(log_buffer.get()->try_pop(curLog))
             {
-                writer.write(curLog);
+                write(curLog);
             }    
             else
+            {
+                writer.tick(coarse_clock.load(std::memory_order_relaxed));
+                log_buffer->prepare_spare();
+                if(write_to_trace* t=atomic_tracer.load(std::memory_order_acquire))
+                    t->flush();
                 std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
         }
         while(log_buffer->try_pop(curLog))
-            writer.write(curLog);
+            write(curLog);
+        report_suppressed();
+    }
+
+    /**
+     * @brief 配置了trace文件时，LOG_SCOPE产生的区间写入trace文件，其余日志写入日志文件；
+     *        飞行记录器模式下日志先保存在内存中，遇到trigger级别的日志时连同之前的日志一起写出
+     * 
+     * @param can_trigger false时即使是trigger级别也只保存，不触发写出
+     */
+    void LittleLogger::write(LogLine& lg,bool can_trigger)
+    {
+        LogLine::span_t span;
+        write_to_trace* t=atomic_tracer.load(std::memory_order_acquire);
+        if(t&&lg.get_span(span))
+            t->write(lg);
+        else if(!recorder)
+            writer.write(lg);
+        else if(can_trigger&&lg.level()==trigger_level)
+        {
+            recorder->dump(writer);
+            writer.write(lg);
+        }
+        else
+            recorder->push(lg);
+    }
+
+    /**
+     * @brief 遍历所有限流调用点，为自上次报告以来有日志被抑制的调用点写一条汇总日志
+     * 
+     */
+    void LittleLogger::report_suppressed()
+    {
+        for(LogSite* site=LogSite::head();site!=nullptr;site=site->next_site())
+        {
+            uint64_t n=site->take_suppressed();
+            if(!n)continue;
+            LogLine lg(LogLevel::WARN,site->file,site->function,site->line);
+            lg<<"suppressed "<<n<<" log lines";
+            //飞行记录器模式下同样先保存在内存中，限流汇总不应触发写出
+            write(lg,false);
+        }
     }
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include <thread>
 #include "QueueBuffer.hpp"
 #include "Write_to_file.hpp"
+#include "Write_to_trace.hpp"
+#include "FlightRecorder.hpp"
 
 
 namespace littlelog
@@ -18,21 +20,45 @@ namespace littlelog
 class LittleLogger
 {
 public:
-    LittleLogger(const std::string& dir,const std::string& file,uint32_t roll_size);
+    LittleLogger(const std::string& dir,const std::string& file,uint32_t roll_size,
+        uint32_t flight_capacity=0,LogLevel trigger=LogLevel::WARN);
 
     ~LittleLogger();
 
     void add(LogLine&& lg);
 
+    void set_collapse_window(uint64_t window_us);
+
+    //只能设置一次，之后LOG_SCOPE的区间写入path而不是日志文件
+    void set_trace_file(const std::string& path);
+
+    //飞行记录器模式下请求后台线程写出内存中的日志
+    void request_dump();
+
+    //在致命信号处理函数中调用：请求写出并等待后台线程完成(最多2秒)，只使用异步信号安全的操作
+    void dump_and_wait();
+
     void work();
+
+    //限流宏被抑制日志的报告周期(微秒)
+    static constexpr const uint64_t suppressed_report_interval=5000000;
     
 private:
     enum class State{
         INTI,READY,SHOUTDOWN
     };
+    void report_suppressed();
+    void write(LogLine& lg,bool can_trigger=true);
+
     std::atomic<State> state;
     std::unique_ptr<QueueBuffer> log_buffer;
     write_to_file writer;
+    std::unique_ptr<write_to_trace> tracer;
+    std::atomic<write_to_trace*> atomic_tracer;
+    std::unique_ptr<FlightRecorder> recorder;
+    const LogLevel trigger_level;
+    std::atomic<bool> dump_requested;
+    std::atomic<uint64_t> dumps_done;
     std::thread read_thread;
 };
 }
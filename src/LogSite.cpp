@@ -0,0 +1,39 @@
+#include "LogSite.hpp"
+#include <chrono>
+
+namespace littlelog
+{
+    std::atomic<uint64_t> coarse_clock(0);
+
+    void update_coarse_clock()
+    {
+        uint64_t now=std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        coarse_clock.store(now,std::memory_order_relaxed);
+    }
+
+    static std::atomic<LogSite*> sites(nullptr);
+
+    LogSite::LogSite(const char* file,const char* function,uint32_t line)
+    :file(file),function(function),line(line),hits(0),passed(0),state(0),reported(0),
+    next(sites.load(std::memory_order_relaxed))
+    {
+        while(!sites.compare_exchange_weak(next,this,std::memory_order_release,std::memory_order_relaxed));
+    }
+
+    LogSite* LogSite::head()
+    {
+        return sites.load(std::memory_order_acquire);
+    }
+
+    uint64_t LogSite::take_suppressed()
+    {
+        //先读passed再读hits，保证hits>=passed；正在输出的日志可能被暂时计入，下次报告时扣除
+        uint64_t p=passed.load(std::memory_order_acquire);
+        uint64_t h=hits.load(std::memory_order_relaxed);
+        uint64_t total=h-p;
+        if(total<=reported)return 0;
+        uint64_t delta=total-reported;
+        reported=total;
+        return delta;
+    }
+}
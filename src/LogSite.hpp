@@ -0,0 +1,113 @@
+#ifndef __LOGSITE_HPP__
+#define __LOGSITE_HPP__
+
+#include <stdint.h>
+#include <atomic>
+
+namespace littlelog
+{
+    /**
+     * @brief 后台线程维护的粗粒度时钟(微秒)，供限流宏使用，避免在被抑制的日志上调用timestamp()
+     *
+     */
+    extern std::atomic<uint64_t> coarse_clock;
+
+    void update_coarse_clock();
+
+    /**
+     * @brief 日志调用点的状态，由LOG_EVERY_N等宏以函数内静态变量的形式为每个调用点创建一个；
+     *        被抑制的日志只执行一次relaxed原子操作，不会构造LogLine。所有调用点串成一个链表，
+     *        后台线程遍历该链表周期性地报告每个调用点被抑制的日志数量
+     *
+     */
+    class LogSite
+    {
+    public:
+        LogSite(const char* file,const char* function,uint32_t line);
+
+        LogSite(const LogSite&)=delete;
+        LogSite& operator=(const LogSite&)=delete;
+
+        //每n条输出一条(第1,n+1,2n+1...条)
+        bool every_n(uint64_t n)
+        {
+            uint64_t c=hits.fetch_add(1,std::memory_order_relaxed);
+            if(n>1&&c%n)return false;
+            passed.fetch_add(1,std::memory_order_release);
+            return true;
+        }
+
+        //只输出前n条
+        bool first_n(uint64_t n)
+        {
+            if(hits.fetch_add(1,std::memory_order_relaxed)>=n)return false;
+            passed.fetch_add(1,std::memory_order_release);
+            return true;
+        }
+
+        //每ms毫秒最多输出一条
+        bool every_ms(uint64_t ms)
+        {
+            uint64_t now=coarse_clock.load(std::memory_order_relaxed);
+            uint64_t next=state.load(std::memory_order_relaxed);
+            if(now<next||!state.compare_exchange_strong(next,now+ms*1000,std::memory_order_relaxed))
+            {
+                hits.fetch_add(1,std::memory_order_relaxed);
+                return false;
+            }
+            hits.fetch_add(1,std::memory_order_relaxed);
+            passed.fetch_add(1,std::memory_order_release);
+            return true;
+        }
+
+        //令牌桶限流(GCRA实现)：平均每秒per_second条，允许连续突发burst条
+        bool rate_limited(uint32_t per_second,uint32_t burst)
+        {
+            const uint64_t now=coarse_clock.load(std::memory_order_relaxed);
+            const uint64_t interval=per_second?1000000/per_second:1000000;
+            const uint64_t tolerance=interval*(burst?burst:1);
+            uint64_t tat=state.load(std::memory_order_relaxed);
+            for(;;)
+            {
+                uint64_t base=tat>now?tat:now;
+                if(base-now>=tolerance)
+                {
+                    hits.fetch_add(1,std::memory_order_relaxed);
+                    return false;
+                }
+                if(state.compare_exchange_weak(tat,base+interval,std::memory_order_relaxed))
+                    break;
+            }
+            hits.fetch_add(1,std::memory_order_relaxed);
+            passed.fetch_add(1,std::memory_order_release);
+            return true;
+        }
+
+        //自上次调用以来新增的被抑制条数，只由后台线程调用
+        uint64_t take_suppressed();
+
+        static LogSite* head();
+        LogSite* next_site() const {return next;}
+
+        const char* const file;
+        const char* const function;
+        const uint32_t line;
+
+    private:
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> passed;
+        std::atomic<uint64_t> state;
+        //后台线程读取的变量，不存在竞争
+        uint64_t reported;
+        LogSite* next;
+    };
+}
+
+/**
+ * @brief 为每个调用点生成一个函数内静态的LogSite，lambda表达式的类型各不相同，因此每个调用点的静态变量独立
+ *
+ */
+#define LITTLELOG_SITE() \
+    [](const char* func)->littlelog::LogSite&{static littlelog::LogSite site(__FILE__,func,__LINE__);return site;}(__func__)
+
+#endif
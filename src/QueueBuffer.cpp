@@ -1,16 +1,27 @@
 #include "QueueBuffer.hpp"
-#include <queue>
+#include <thread>
 
 namespace littlelog
 {
-    QueueBuffer::QueueBuffer():cur_read_buffer(nullptr),flag(ATOMIC_FLAG_INIT),write_index(0),read_index(0)
+    QueueBuffer::QueueBuffer():cur_write_buffer(new Buffer()),write_index(0),read_index(0),spare(new Buffer())
     {
-        setup_new_buffer();
+        cur_read_buffer=cur_write_buffer.load(std::memory_order_relaxed);
+    }
+
+    QueueBuffer::~QueueBuffer()
+    {
+        while(cur_read_buffer)
+        {
+            Buffer* next=cur_read_buffer->next.load(std::memory_order_acquire);
+            delete cur_read_buffer;
+            cur_read_buffer=next;
+        }
+        delete spare.load(std::memory_order_acquire);
     }
 
     void QueueBuffer::push(LogLine&& lg)
     {
-        unsigned int next_write=write_index.fetch_add(1,std::memory_order_relaxed);
+        unsigned int next_write=write_index.fetch_add(1,std::memory_order_acquire);
         if(next_write<Buffer::sz)
         {
             if(cur_write_buffer.load(std::memory_order_acquire)->push(std::move(lg),next_write))
@@ -18,47 +29,61 @@ namespace littlelog
         }
         else
         {
-            while(write_index.load(std::memory_order_acquire)>=Buffer::sz);
+            //当前缓冲区已满，等待写满它的生产者挂上新的缓冲区；让出CPU以免与该生产者争抢
+            while(write_index.load(std::memory_order_acquire)>=Buffer::sz)
+                std::this_thread::yield();
             push(std::move(lg));
         }
     }
 
-    void QueueBuffer::get_next_read_buffer()
-     {
-        SpinLock sp(flag);
-        cur_read_buffer=buffers.size()?buffers.front().get():nullptr;
-    }
-
     bool QueueBuffer::try_pop(LogLine& lg)
     {
-        if(cur_read_buffer==nullptr)
-            get_next_read_buffer();
-        if(cur_read_buffer==nullptr)
-            return false;
-        Buffer* bf=cur_read_buffer;
-        if(bool succedd=bf->try_pop(lg,read_index))
+        if(read_index==Buffer::sz)//该日志缓冲区已读完
+        {
+            //写满该缓冲区的生产者可能还没挂上下一个缓冲区，此时不能释放
+            Buffer* next=cur_read_buffer->next.load(std::memory_order_acquire);
+            if(next==nullptr)
+                return false;
+            //所有生产者都已写完该缓冲区，已有备用缓冲区时才释放
+            cur_read_buffer->reset();
+            Buffer* expected=nullptr;
+            if(!spare.compare_exchange_strong(expected,cur_read_buffer,std::memory_order_release,std::memory_order_relaxed))
+                delete cur_read_buffer;
+            cur_read_buffer=next;
+            read_index=0;
+        }
+        if(cur_read_buffer->try_pop(lg,read_index))
         {
             read_index++;
-            if(read_index==Buffer::sz)//该日志缓冲区已读完
-            {
-                read_index=0;
-                cur_read_buffer=nullptr;
-                SpinLock sp(flag);
-                buffers.pop();
-            }
             return true;
         }
         else
             return false;
     }
 
+    /**
+     * @brief 只由写满当前缓冲区的那个生产者调用：先挂到链尾，再发布为当前写缓冲区，最后重置写下标
+     * 
+     */
     void QueueBuffer::setup_new_buffer()
     {
-        std::unique_ptr<Buffer> next_buffer(new Buffer());
-        cur_write_buffer.store(next_buffer.get(),std::memory_order_release);
-        SpinLock sl(flag);
-        buffers.push(std::move(next_buffer));
-        write_index.store(0,std::memory_order_relaxed);
+        Buffer* next_buffer=spare.exchange(nullptr,std::memory_order_acquire);
+        if(next_buffer==nullptr)
+            next_buffer=new Buffer();
+        Buffer* cur=cur_write_buffer.load(std::memory_order_relaxed);
+        cur->next.store(next_buffer,std::memory_order_release);
+        cur_write_buffer.store(next_buffer,std::memory_order_release);
+        write_index.store(0,std::memory_order_release);
+    }
+
+    void QueueBuffer::prepare_spare()
+    {
+        if(spare.load(std::memory_order_relaxed)!=nullptr)
+            return;
+        Buffer* buffer=new Buffer();
+        Buffer* expected=nullptr;
+        if(!spare.compare_exchange_strong(expected,buffer,std::memory_order_release,std::memory_order_relaxed))
+            delete buffer;
     }
 
-}
\ No newline at end of file
+}
@@ -2,14 +2,14 @@
 #define __QUEUEBUFFER_HPP_
 
 #include "Buffer.hpp"
-#include "SpinLock.hpp"
 #include <atomic>
-#include <queue>
 
 namespace littlelog
 {
     /**
-     * @brief 日志信息缓冲区队列，用来存放Buffer
+     * @brief 日志信息缓冲区队列，Buffer通过原子的next指针串成单链表：生产者在链尾追加，
+     *        后台线程从链头读取并释放，缓冲区的交接不需要加锁。
+     *        后台线程读完的缓冲区重置后留作备用，写满缓冲区的生产者直接取用，不在日志调用中分配8MB内存
      * 
      */
 class QueueBuffer
@@ -17,28 +17,34 @@ class QueueBuffer
 public:
     QueueBuffer();
 
-    void push(LogLine&& lg);
+    ~QueueBuffer();
 
-    void get_next_read_buffer();
+    void push(LogLine&& lg);
 
     bool try_pop(LogLine& lg);
     
     void setup_new_buffer();
 
+    //后台线程空闲时调用，没有备用缓冲区时分配一个
+    void prepare_spare();
+
+    QueueBuffer(const QueueBuffer&)=delete;
+    QueueBuffer& operator=(const QueueBuffer&)=delete;
+
 private:
     //保证数据同步
-    //多个线程的消费者共同访问，需要使用原子变量或者加锁
-    std::queue<std::unique_ptr<Buffer>> buffers;
+    //多个线程的生产者共同访问，需要使用原子变量
     std::atomic<Buffer*> cur_write_buffer;
-    std::atomic<int> write_index;
-    std::atomic_flag flag;
-    //主线程读取的变量，不存在竞争
+    std::atomic<unsigned int> write_index;
+    //主线程读取的变量，不存在竞争；cur_read_buffer为链头
     Buffer* cur_read_buffer;
     unsigned int read_index;
+    //备用缓冲区，由后台线程放入，由写满缓冲区的生产者取走
+    std::atomic<Buffer*> spare;
     
 };
 }
 
 
 
-#endif
\ No newline at end of file
+#endif
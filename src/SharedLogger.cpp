@@ -0,0 +1,49 @@
+#include "SharedLogger.hpp"
+#include "LittleLogger.hpp"
+
+namespace littlelog
+{
+    SharedLogger::SharedLogger(const std::string& name,uint32_t ring_size):
+    running(true),ring(name,ring_size),tick_thread(&SharedLogger::work,this)
+    {
+    }
+
+    SharedLogger::~SharedLogger()
+    {
+        running.store(false);
+        tick_thread.join();
+    }
+
+    void SharedLogger::add(LogLine&& lg)
+    {
+        ring.push(lg);
+    }
+
+    void SharedLogger::work()
+    {
+        uint64_t last_report=coarse_clock.load(std::memory_order_relaxed);
+        while(running.load(std::memory_order_acquire))
+        {
+            update_coarse_clock();
+            if(coarse_clock.load(std::memory_order_relaxed)-last_report>=LittleLogger::suppressed_report_interval)
+            {
+                report_suppressed();
+                last_report=coarse_clock.load(std::memory_order_relaxed);
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        report_suppressed();
+    }
+
+    void SharedLogger::report_suppressed()
+    {
+        for(LogSite* site=LogSite::head();site!=nullptr;site=site->next_site())
+        {
+            uint64_t n=site->take_suppressed();
+            if(!n)continue;
+            LogLine lg(LogLevel::WARN,site->file,site->function,site->line);
+            lg<<"suppressed "<<n<<" log lines";
+            ring.push(lg);
+        }
+    }
+}
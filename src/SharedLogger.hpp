@@ -0,0 +1,36 @@
+#ifndef __SHAREDLOGGER_HPP__
+#define __SHAREDLOGGER_HPP__
+
+#include <string>
+#include <atomic>
+#include <thread>
+#include "ShmRing.hpp"
+
+namespace littlelog
+{
+/**
+ * @brief 进程外后端模式下应用进程一侧的日志器：日志直接编码进共享内存环形缓冲区，由littlelogd
+ *      格式化并写入文件；进程内只保留一个轻量的线程，负责刷新粗粒度时钟和报告限流宏抑制的日志
+ * 
+ */
+class SharedLogger
+{
+public:
+    SharedLogger(const std::string& name,uint32_t ring_size);
+
+    ~SharedLogger();
+
+    void add(LogLine&& lg);
+
+    void work();
+
+private:
+    void report_suppressed();
+
+    std::atomic<bool> running;
+    ShmRing ring;
+    std::thread tick_thread;
+};
+}
+
+#endif
@@ -0,0 +1,270 @@
+#include "ShmRing.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <thread>
+#include <stdexcept>
+
+namespace littlelog
+{
+    static constexpr const char ring_magic[8]={'L','L','R','I','N','G','0','2'};
+
+    static std::string shm_path(const std::string& name)
+    {
+        return name.size()&&name[0]=='/'?name:"/"+name;
+    }
+
+    static bool process_alive(pid_t pid)
+    {
+        return pid>0&&(kill(pid,0)==0||errno!=ESRCH);
+    }
+
+    ShmRing::ShmRing(const std::string& name,uint32_t size_mb):header(nullptr),pid((static_cast<uint64_t>(getpid())&PID_MASK)<<PID_SHIFT),
+    data(nullptr),mapped_size(0),peeked(0)
+    {
+        const std::string path=shm_path(name);
+        bool created=true;
+        int fd=shm_open(path.c_str(),O_RDWR|O_CREAT|O_EXCL,0600);
+        if(fd<0&&errno==EEXIST)
+        {
+            created=false;
+            fd=shm_open(path.c_str(),O_RDWR,0600);
+        }
+        if(fd<0)
+            throw std::runtime_error("shm_open "+path+" failed");
+
+        if(created)
+        {
+            mapped_size=data_offset+static_cast<size_t>(size_mb)*1024*1024;
+            if(ftruncate(fd,mapped_size)!=0)
+            {
+                close(fd);
+                throw std::runtime_error("ftruncate "+path+" failed");
+            }
+        }
+        else
+        {
+            //创建者可能还没来得及ftruncate
+            struct stat st;
+            for(int i=0;i<1000&&fstat(fd,&st)==0&&st.st_size==0;i++)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            mapped_size=fstat(fd,&st)==0?st.st_size:0;
+            if(mapped_size<=data_offset)
+            {
+                close(fd);
+                throw std::runtime_error(path+" is not a littlelog ring");
+            }
+        }
+
+        void* p=mmap(nullptr,mapped_size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+        close(fd);
+        if(p==MAP_FAILED)
+            throw std::runtime_error("mmap "+path+" failed");
+        header=static_cast<Header*>(p);
+        data=static_cast<char*>(p)+data_offset;
+
+        if(created)
+        {
+            new (header) Header();
+            memcpy(header->magic,ring_magic,sizeof(ring_magic));
+            header->capacity=mapped_size-data_offset;
+            header->ready.store(1,std::memory_order_release);
+        }
+        else
+        {
+            for(int i=0;i<1000&&!header->ready.load(std::memory_order_acquire);i++)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if(!header->ready.load(std::memory_order_acquire)||memcmp(header->magic,ring_magic,sizeof(ring_magic))!=0
+                ||header->capacity!=mapped_size-data_offset)
+            {
+                munmap(p,mapped_size);
+                throw std::runtime_error(path+" is not a littlelog ring");
+            }
+        }
+    }
+
+    ShmRing::~ShmRing()
+    {
+        if(header)
+            munmap(header,mapped_size);
+    }
+
+    std::atomic<uint64_t>* ShmRing::record_at(uint64_t pos)
+    {
+        return reinterpret_cast<std::atomic<uint64_t>*>(data+pos%header->capacity);
+    }
+
+    uint64_t ShmRing::lap_tag(uint64_t pos) const
+    {
+        return ((pos/header->capacity)<<LAP_SHIFT)&LAP_MASK;
+    }
+
+    bool ShmRing::owns(uint64_t pos,uint64_t state) const
+    {
+        return state&&(state>>LAP_SHIFT)==(lap_tag(pos)>>LAP_SHIFT);
+    }
+
+    bool ShmRing::current(uint64_t pos) const
+    {
+        return header->write_pos.load(std::memory_order_acquire)==pos&&header->read_pos.load(std::memory_order_acquire)<=pos;
+    }
+
+    /**
+     * @brief pos刚被确认仍等于write_pos，位于空闲区的pos处只可能是pos的占有或更早圈的过期占有；
+     *        只清除圈数标记严格早于pos所在圈的记录头
+     *
+     */
+    void ShmRing::clear_stale(uint64_t pos,uint64_t state)
+    {
+        uint64_t age=((lap_tag(pos)-(state&LAP_MASK))>>LAP_SHIFT)&(LAP_MASK>>LAP_SHIFT);
+        if(age==0||age>(LAP_MASK>>LAP_SHIFT)/2)
+            return;
+        record_at(pos)->compare_exchange_strong(state,0,std::memory_order_acq_rel,std::memory_order_relaxed);
+    }
+
+    void ShmRing::help_advance(uint64_t pos,uint64_t state)
+    {
+        header->write_pos.compare_exchange_strong(pos,pos+(state&LENGTH),std::memory_order_acq_rel,std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 生产者：CAS占有write_pos处的记录头(放不下时先占有一条PADDING记录)，推进write_pos，
+     *        写入编码后再置READY位
+     *
+     * @param lg
+     * @return false :缓冲区已满，日志被丢弃
+     */
+    bool ShmRing::push(const LogLine& lg)
+    {
+        //自定义类型和区间参数只格式化一次
+        static thread_local std::string encoded;
+        encoded.clear();
+        lg.to_portable(encoded);
+
+        const uint64_t capacity=header->capacity;
+        const uint64_t need=(sizeof(uint64_t)+sizeof(uint32_t)+encoded.size()+7)&~static_cast<uint64_t>(7);
+        if(need>capacity/2)
+        {
+            header->dropped.fetch_add(1,std::memory_order_relaxed);
+            return false;
+        }
+
+        uint64_t w;
+        for(;;)
+        {
+            w=header->write_pos.load(std::memory_order_acquire);
+            uint64_t r=header->read_pos.load(std::memory_order_acquire);
+            if(r>w)
+                continue;
+            uint64_t offset=w%capacity;
+            uint64_t padding=offset+need>capacity?capacity-offset:0;
+            if(w+padding+need-r>capacity)
+            {
+                header->dropped.fetch_add(1,std::memory_order_relaxed);
+                return false;
+            }
+            std::atomic<uint64_t>* record=record_at(w);
+            uint64_t state=record->load(std::memory_order_acquire);
+            //w已过期时w%capacity处可能是后一圈的有效记录或其内容，不能改动
+            if(!current(w))
+                continue;
+            if(state)
+            {
+                if(owns(w,state))
+                    help_advance(w,state);
+                else
+                    clear_stale(w,state);
+                continue;
+            }
+            uint64_t desired=(padding?padding|PADDING|READY:need)|pid|lap_tag(w);
+            if(!record->compare_exchange_strong(state,desired,std::memory_order_acq_rel,std::memory_order_acquire))
+                continue;
+            //w在读取之后已被其他生产者写入并被消费，这次占有已过期
+            if(header->read_pos.load(std::memory_order_acquire)>w)
+            {
+                record->compare_exchange_strong(desired,0,std::memory_order_acq_rel,std::memory_order_relaxed);
+                continue;
+            }
+            help_advance(w,desired);
+            if(!padding)
+                break;
+        }
+
+        char* payload=reinterpret_cast<char*>(record_at(w));
+        *reinterpret_cast<uint32_t*>(payload+sizeof(uint64_t))=static_cast<uint32_t>(encoded.size());
+        memcpy(payload+sizeof(uint64_t)+sizeof(uint32_t),encoded.data(),encoded.size());
+        record_at(w)->store(need|pid|lap_tag(w)|READY,std::memory_order_release);
+        return true;
+    }
+
+    bool ShmRing::try_peek(LogLine& lg)
+    {
+        uint64_t r=header->read_pos.load(std::memory_order_relaxed);
+        for(;;)
+        {
+            std::atomic<uint64_t>* record=record_at(r);
+            uint64_t state=record->load(std::memory_order_acquire);
+            uint64_t w=header->write_pos.load(std::memory_order_acquire);
+            if(r==w)
+            {
+                if(!state)
+                    return false;
+                //写入者占有记录后、推进write_pos前退出，代为推进；过期的占有则清除
+                if(owns(r,state))
+                    help_advance(w,state);
+                else if(current(r))
+                    clear_stale(r,state);
+                continue;
+            }
+            //读取记录头之后记录才被占有，交给调用者稍后重试，不在这里自旋
+            if(!state)
+                return false;
+            uint32_t length=static_cast<uint32_t>(state&LENGTH);
+            if(!(state&READY))
+            {
+                //写入者在提交前退出，这条记录永远不会完成
+                if(process_alive(static_cast<pid_t>((state>>PID_SHIFT)&PID_MASK)))
+                    return false;
+                release(r,length);
+                r+=length;
+                continue;
+            }
+            if(state&PADDING)
+            {
+                release(r,length);
+                r+=length;
+                continue;
+            }
+            const char* payload=reinterpret_cast<const char*>(record);
+            uint32_t size=*reinterpret_cast<const uint32_t*>(payload+sizeof(uint64_t));
+            lg=LogLine::from_portable(payload+sizeof(uint64_t)+sizeof(uint32_t),size);
+            peeked=length;
+            return true;
+        }
+    }
+
+    void ShmRing::pop()
+    {
+        if(!peeked)return;
+        release(header->read_pos.load(std::memory_order_relaxed),peeked);
+        peeked=0;
+    }
+
+    /**
+     * @brief 清零已读的记录后再推进read_pos，保证生产者复用这段空间时看到的状态为0
+     *
+     */
+    void ShmRing::release(uint64_t pos,uint32_t length)
+    {
+        memset(data+pos%header->capacity,0,length);
+        header->read_pos.store(pos+length,std::memory_order_release);
+    }
+
+    uint64_t ShmRing::take_dropped()
+    {
+        return header->dropped.exchange(0,std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef __SHMRING_HPP__
+#define __SHMRING_HPP__
+
+#include <string>
+#include <atomic>
+#include "LittleLog.hpp"
+
+namespace littlelog
+{
+    /**
+     * @brief 位于命名共享内存(/dev/shm)中的多生产者单消费者环形缓冲区。应用进程以与地址空间无关的
+     *        编码写入日志，littlelogd进程读取、格式化并写入文件；应用进程崩溃后已提交的日志仍可被读出。
+     *        每条记录以8字节对齐，前8字节为记录头(长度、状态位、写入者的pid和所在圈数的标记)，
+     *        之后4字节为编码长度。生产者先用CAS把记录头从0改为长度和pid来占有位置，再推进write_pos，
+     *        任何一方看到已占有但write_pos尚未推进的记录都可以代为推进，因此写入者在任何时刻崩溃，
+     *        消费者都能根据记录头中的长度和pid跳过这条未完成的记录。
+     *        生产者只在确认快照w仍等于write_pos后才读取或改动w处的记录头；圈数标记用来识别确认与CAS之间
+     *        被抢占太久的生产者留下的过期占有：它们不会被代为推进，占有者校验read_pos后撤销，
+     *        其他生产者和消费者也只在再次确认write_pos后清除圈数更早的记录头。
+     *        确认与CAS之间若恰好有整整一圈的日志写入并消费，过期占有仍可能短暂覆盖新记录的8字节内容，
+     *        这需要16字节的原子操作才能完全避免。
+     *        缓冲区满时新的日志被丢弃并计数，不会阻塞应用进程
+     *
+     */
+    class ShmRing
+    {
+    public:
+        //打开名为name的共享内存，不存在时创建，size_mb仅在创建时生效
+        ShmRing(const std::string& name,uint32_t size_mb);
+
+        ~ShmRing();
+
+        bool push(const LogLine& lg);
+
+        //取出最早的一条日志，lg引用共享内存，处理完后必须调用pop()
+        bool try_peek(LogLine& lg);
+
+        void pop();
+
+        //自上次调用以来因缓冲区满被丢弃的条数
+        uint64_t take_dropped();
+
+        ShmRing(const ShmRing&)=delete;
+        ShmRing& operator=(const ShmRing&)=delete;
+
+    private:
+        struct Header
+        {
+            char magic[8];
+            uint64_t capacity;
+            std::atomic<uint32_t> ready;
+            alignas(64) std::atomic<uint64_t> write_pos;
+            alignas(64) std::atomic<uint64_t> read_pos;
+            alignas(64) std::atomic<uint64_t> dropped;
+        };
+        //记录头：0~29位长度，30位PADDING，31位READY，32~53位pid，54~63位圈数标记
+        static constexpr const uint64_t READY=1u<<31;
+        static constexpr const uint64_t PADDING=1u<<30;
+        static constexpr const uint64_t LENGTH=PADDING-1;
+        static constexpr const int PID_SHIFT=32;
+        static constexpr const uint64_t PID_MASK=(1u<<22)-1;
+        static constexpr const int LAP_SHIFT=54;
+        static constexpr const uint64_t LAP_MASK=~((static_cast<uint64_t>(1)<<LAP_SHIFT)-1);
+        static constexpr const size_t data_offset=(sizeof(Header)+255)&~static_cast<size_t>(255);
+
+        std::atomic<uint64_t>* record_at(uint64_t pos);
+        void release(uint64_t pos,uint32_t length);
+        uint64_t lap_tag(uint64_t pos) const;
+        //state是否是位置pos上的有效占有(而不是过期的占有)
+        bool owns(uint64_t pos,uint64_t state) const;
+        //pos是否仍等于write_pos且尚未被消费，即调用者的快照没有过期
+        bool current(uint64_t pos) const;
+        void clear_stale(uint64_t pos,uint64_t state);
+        //记录头为state的位置pos已被占有，write_pos仍停在pos时代为推进
+        void help_advance(uint64_t pos,uint64_t state);
+
+        Header* header;
+        //本进程的pid，已移到记录头中pid所在的位
+        const uint64_t pid;
+        char* data;
+        size_t mapped_size;
+        //消费者读取的变量，不存在竞争
+        uint32_t peeked;
+    };
+}
+
+#endif
@@ -6,19 +6,112 @@ namespace littlelog
     write_to(dir+file),roll_size_bytes(roll_size*1024*1024)
     {
         roll_file();
-    }   
+    }
+
+    write_to_file::~write_to_file()
+    {
+        flush_repeats();
+        close_block();
+    }
 
     void write_to_file::write(LogLine& lg)
+    {
+        uint64_t window=collapse_window.load(std::memory_order_relaxed);
+        if(window)
+        {
+            const char* file=lg.file()?lg.file():"";
+            const char* function=lg.function()?lg.function():"";
+            size_t length;
+            const char* payload=lg.payload(length);
+            uint32_t line=lg.line();
+            LogLevel level=lg.level();
+            key.assign(file);
+            key.push_back('\0');
+            key.append(function);
+            key.push_back('\0');
+            key.append(reinterpret_cast<const char*>(&line),sizeof(line));
+            key.append(reinterpret_cast<const char*>(&level),sizeof(level));
+            key.append(payload,length);
+            if(key==last_key&&lg.time()-first_time<=window)
+            {
+                repeats++;
+                last_time=lg.time();
+                last_thread=lg.thread_id();
+                return;
+            }
+            flush_repeats();
+            last_key.swap(key);
+            last_file=file;
+            last_function=function;
+            last_line=line;
+            last_level=level;
+            first_time=lg.time();
+        }
+        write_line(lg);
+    }
+
+    void write_to_file::set_collapse_window(uint64_t window_us)
+    {
+        collapse_window.store(window_us,std::memory_order_relaxed);
+    }
+
+    void write_to_file::tick(uint64_t now)
+    {
+        if(repeats&&now-first_time>collapse_window.load(std::memory_order_relaxed))
+        {
+            flush_repeats();
+            last_key.clear();
+        }
+    }
+
+    void write_to_file::flush_repeats()
+    {
+        if(!repeats)return;
+        LogLine lg(last_level,last_file.c_str(),last_function.c_str(),last_line,last_time,last_thread);
+        lg<<"last message repeated "<<repeats<<" times";
+        repeats=0;
+        write_line(lg);
+    }
+
+    void write_to_file::write_line(LogLine& lg)
     {
         auto pos=os->tellp();
         lg.stringify(*os);
-        bytes_writed+=os->tellp()-pos;
+        uint32_t n=os->tellp()-pos;
+
+        uint64_t t=lg.time();
+        if(!block.length)
+        {
+            block.offset=bytes_writed;
+            block.min_time=block.max_time=t;
+        }
+        block.min_time=std::min(block.min_time,t);
+        block.max_time=std::max(block.max_time,t);
+        block.levels|=1u<<static_cast<uint32_t>(lg.level());
+        block.length+=n;
+        if(block.length>=index_block_size)
+            close_block();
+
+        bytes_writed+=n;
         if(bytes_writed>=roll_size_bytes)
             roll_file();
     }
 
+    /**
+     * @brief 把当前块追加到索引文件中，每个条目写完即flush，保证查询工具能看到正在写的文件的索引
+     *
+     */
+    void write_to_file::close_block()
+    {
+        if(!block.length||!index_os)return;
+        index_os->write(reinterpret_cast<const char*>(&block),sizeof(block));
+        index_os->flush();
+        block=IndexEntry{};
+    }
+
     void write_to_file::roll_file()
     {
+        close_block();
         if(os)
         {
             os->flush();
@@ -32,6 +125,11 @@ namespace littlelog
         file_number++;
         file_name.append(".txt");
         os->open(file_name,std::ofstream::out|std::ofstream::trunc);
+
+        index_os.reset(new std::ofstream());
+        index_os->open(file_name+".idx",std::ofstream::out|std::ofstream::trunc|std::ofstream::binary);
+        index_os->write(index_magic,sizeof(index_magic));
+        index_os->flush();
     }
 
-}
\ No newline at end of file
+}
@@ -4,30 +4,82 @@
 #include <string>
 #include "LittleLog.hpp"
 #include <fstream>
+#include <atomic>
 
 namespace littlelog
 {
     /**
+     * @brief 日志文件的稀疏索引条目，每个日志文件log.N.txt对应一个索引文件log.N.txt.idx，
+     *        文件头为index_magic，之后每写满index_block_size字节的日志记录一个条目
+     *
+     */
+    struct IndexEntry
+    {
+        uint64_t offset;    //块在日志文件中的起始偏移
+        uint64_t min_time;  //块内日志的最小时间戳(微秒)
+        uint64_t max_time;  //块内日志的最大时间戳(微秒)
+        uint32_t length;    //块的字节数，块总是在行边界结束
+        uint32_t levels;    //块内出现过的日志级别，第i位对应LogLevel(i)
+    };
+
+    static constexpr const char index_magic[8]={'L','L','I','D','X','0','0','1'};
+
+    /**
  * @brief 向文件中写日志信息
- * 
+ *
  */
 class write_to_file
 {
 public:
     write_to_file(const std::string& dir,const std::string& file,uint32_t roll_size);
 
+    ~write_to_file();
+
     void write(LogLine& lg);
-    
+
     void roll_file();
 
+    /**
+     * @brief 合并重复日志：同一调用点、同一级别、参数编码完全相同的连续日志，在第一条之后window_us
+     *        微秒内只计数，之后写一条"last message repeated N times"；0表示关闭(默认)
+     *
+     */
+    void set_collapse_window(uint64_t window_us);
+
+    //后台线程空闲时调用，时间窗口已过的重复计数及时写出
+    void tick(uint64_t now);
+
+    static constexpr const uint32_t index_block_size=64*1024;
+
 private:
+    void write_line(LogLine& lg);
+    void close_block();
+    void flush_repeats();
+
     std::unique_ptr<std::ofstream> os;
+    std::unique_ptr<std::ofstream> index_os;
     const std::string write_to;
     const uint32_t roll_size_bytes;
     uint32_t file_number=0;
     uint32_t bytes_writed=0;
+    //当前尚未写入索引的块
+    IndexEntry block{};
+
+    std::atomic<uint64_t> collapse_window{0};
+    //上一条写出的日志，用于检测重复
+    std::string last_key;
+    std::string key;
+    std::string last_file;
+    std::string last_function;
+    uint32_t last_line=0;
+    LogLevel last_level=LogLevel::INFO;
+    uint64_t first_time=0;
+    //最后一条被合并的重复日志的时间和线程，汇总行使用它们
+    uint64_t last_time=0;
+    std::thread::id last_thread;
+    uint64_t repeats=0;
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,60 @@
+#include "Write_to_trace.hpp"
+#include <unistd.h>
+
+namespace littlelog
+{
+    static void write_json_string(std::ostream& os,const char* s)
+    {
+        os<<'"';
+        for(;s&&*s;s++)
+        {
+            unsigned char c=static_cast<unsigned char>(*s);
+            if(c=='"'||c=='\\')
+                os<<'\\'<<*s;
+            else if(c<0x20)
+            {
+                char b[8];
+                snprintf(b,sizeof(b),"\\u%04x",c);
+                os<<b;
+            }
+            else
+                os<<*s;
+        }
+        os<<'"';
+    }
+
+    write_to_trace::write_to_trace(const std::string& path):
+    os(path,std::ofstream::out|std::ofstream::trunc),pid(getpid())
+    {
+        os<<"[\n";
+    }
+
+    write_to_trace::~write_to_trace()
+    {
+        os<<"\n]\n";
+    }
+
+    void write_to_trace::write(const LogLine& lg)
+    {
+        LogLine::span_t span;
+        if(!lg.get_span(span))return;
+        if(!first)os<<",\n";
+        first=false;
+        os<<"{\"name\":";
+        write_json_string(os,span.name);
+        os<<",\"cat\":\"littlelog\",\"ph\":\"X\",\"ts\":"<<span.begin<<",\"dur\":"<<span.end-span.begin
+          <<",\"pid\":"<<pid<<",\"tid\":"<<lg.thread_id()<<",\"args\":{\"file\":";
+        write_json_string(os,lg.file());
+        os<<",\"function\":";
+        write_json_string(os,lg.function());
+        os<<",\"line\":"<<lg.line()<<"}}";
+        dirty=true;
+    }
+
+    void write_to_trace::flush()
+    {
+        if(!dirty)return;
+        os.flush();
+        dirty=false;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef __WRITE_TO_TRACE__
+#define __WRITE_TO_TRACE__
+
+#include <string>
+#include "LittleLog.hpp"
+#include <fstream>
+
+namespace littlelog
+{
+    /**
+ * @brief 把LOG_SCOPE产生的区间写成Chrome trace-event格式的JSON("ph":"X"的完整事件)，
+ *      文件可直接用chrome://tracing或Perfetto打开
+ * 
+ */
+class write_to_trace
+{
+public:
+    explicit write_to_trace(const std::string& path);
+
+    ~write_to_trace();
+
+    void write(const LogLine& lg);
+
+    //后台线程空闲时调用，把已写的事件刷到磁盘
+    void flush();
+
+private:
+    std::ofstream os;
+    const int pid;
+    bool first=true;
+    bool dirty=false;
+};
+
+}
+
+#endif
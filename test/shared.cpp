@@ -0,0 +1,168 @@
+#include <iostream>
+#include "LittleLog.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+/**
+ * @brief 共享内存模式测试：子进程通过init_shared写日志后正常退出、abort()、在写日志过程中被SIGKILL，
+ *        以及write_pos处留有过期生产者的占有时继续写日志，检查littlelogd(与本程序位于同一目录)写出的文件中
+ *        每个正常提交的日志都在，且守护进程没有被未完成的记录卡住，收到SIGTERM后按时退出
+ *
+ */
+const int cnt=10000;
+const char* ring_name="littlelog_shared_test";
+
+//子进程：写cnt条带tag的日志
+void produce(const char* tag)
+{
+    littlelog::init_shared(ring_name,16);
+    for(int i=0;i<cnt;i++)
+        LOG_INFO<<tag<<' '<<i;
+}
+
+pid_t spawn(void (*f)())
+{
+    pid_t pid=fork();
+    if(pid==0)
+    {
+        f();
+        exit(0);
+    }
+    return pid;
+}
+
+void exit_normally()
+{
+    produce("shared-exit");
+}
+
+void crash()
+{
+    struct rlimit no_core={0,0};
+    setrlimit(RLIMIT_CORE,&no_core);
+    produce("shared-abort");
+    abort();
+}
+
+//多个线程不停写日志，由父进程在任意时刻SIGKILL，可能留下已占有但未提交的记录
+void killed()
+{
+    littlelog::init_shared(ring_name,16);
+    auto f=[]{for(int i=0;;i++)LOG_INFO<<"shared-killed "<<i;};
+    std::thread t1(f),t2(f);
+    t1.join();
+}
+
+void after()
+{
+    produce("shared-after");
+}
+
+void stale()
+{
+    produce("shared-stale");
+}
+
+/**
+ * @brief 模拟被抢占过一整圈的生产者：在write_pos处写入圈数更早、尚未提交的占有。
+ *        偏移与ShmRing::Header一致：write_pos位于64字节处，数据区从256字节开始，记录头54~63位为圈数标记
+ *
+ */
+void inject_stale_claim()
+{
+    int fd=shm_open((std::string("/")+ring_name).c_str(),O_RDWR,0600);
+    struct stat st;
+    fstat(fd,&st);
+    char* p=static_cast<char*>(mmap(nullptr,st.st_size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0));
+    close(fd);
+    const uint64_t capacity=st.st_size-256;
+    uint64_t w=reinterpret_cast<std::atomic<uint64_t>*>(p+64)->load();
+    uint64_t older_lap=((w/capacity+1023)&1023)<<54;
+    reinterpret_cast<std::atomic<uint64_t>*>(p+256+w%capacity)->store(older_lap|64);
+    munmap(p,st.st_size);
+}
+
+int count_lines(const std::string& path,const std::string& tag)
+{
+    std::ifstream in(path);
+    std::string line;
+    int n=0;
+    while(std::getline(in,line))
+        if(line.find(tag+' ')!=std::string::npos)n++;
+    return n;
+}
+
+int main(int argc,char** argv)
+{
+    std::string dir=argv[0];
+    dir=dir.find('/')==std::string::npos?".":dir.substr(0,dir.rfind('/'));
+    const std::string daemon=dir+"/littlelogd";
+    shm_unlink((std::string("/")+ring_name).c_str());
+
+    //守护进程启动前写入并退出，守护进程启动后应能读出
+    waitpid(spawn(exit_normally),nullptr,0);
+    waitpid(spawn(crash),nullptr,0);
+    inject_stale_claim();
+    waitpid(spawn(stale),nullptr,0);
+
+    pid_t daemon_pid=fork();
+    if(daemon_pid==0)
+    {
+        execl(daemon.c_str(),daemon.c_str(),"--size","16",ring_name,"/tmp/","shared",nullptr);
+        perror(daemon.c_str());
+        _exit(127);
+    }
+
+    for(int i=0;i<5;i++)
+    {
+        pid_t pid=spawn(killed);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        kill(pid,SIGKILL);
+        waitpid(pid,nullptr,0);
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    //守护进程空闲时遇到过期的占有
+    inject_stale_claim();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    waitpid(spawn(after),nullptr,0);
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    //写出剩余日志后应在SIGTERM后很快退出
+    kill(daemon_pid,SIGTERM);
+    int status;
+    pid_t exited=0;
+    for(int i=0;i<500&&(exited=waitpid(daemon_pid,&status,WNOHANG))==0;i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    shm_unlink((std::string("/")+ring_name).c_str());
+    if(exited!=daemon_pid)
+    {
+        kill(daemon_pid,SIGKILL);
+        waitpid(daemon_pid,nullptr,0);
+        printf("\tlittlelogd did not exit on SIGTERM\n");
+        return 1;
+    }
+    if(!WIFEXITED(status)||WEXITSTATUS(status)!=0)
+    {
+        printf("\tlittlelogd failed\n");
+        return 1;
+    }
+
+    int failed=0;
+    for(const char* tag:{"shared-exit","shared-abort","shared-stale","shared-after"})
+    {
+        int n=count_lines("/tmp/shared.0.txt",tag);
+        printf("\t%s: %d/%d lines\n",tag,n,cnt);
+        failed+=n!=cnt;
+    }
+    return failed;
+}
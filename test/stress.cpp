@@ -0,0 +1,51 @@
+#include <iostream>
+#include "LittleLog.hpp"
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cinttypes>
+
+/**
+ * @brief 多线程压力测试：每个线程记录每条日志的延迟，输出不同线程数下的延迟分位数
+ *
+ */
+const int cnt=200000;
+
+void work(std::vector<uint64_t>& latency)
+{
+    latency.resize(cnt);
+    for(int i=0;i<cnt;i++)
+    {
+        auto start=std::chrono::steady_clock::now();
+        LOG_INFO<<"stress "<<i<<' '<<3.14;
+        auto end=std::chrono::steady_clock::now();
+        latency[i]=std::chrono::duration_cast<std::chrono::nanoseconds>(end-start).count();
+    }
+}
+
+void benchmark(int count)
+{
+    std::vector<std::vector<uint64_t>> latency(count);
+    std::vector<std::thread> threads;
+    for(int i=0;i<count;i++)threads.push_back(std::thread(work,std::ref(latency[i])));
+    for(int i=0;i<count;i++)threads[i].join();
+
+    std::vector<uint64_t> all;
+    for(auto& l:latency)all.insert(all.end(),l.begin(),l.end());
+    std::sort(all.begin(),all.end());
+    auto percentile=[&all](double p){return all[static_cast<size_t>(p*(all.size()-1))];};
+    printf("\tthreads=%2d p50=%6" PRIu64 " ns p99=%8" PRIu64 " ns p99.9=%9" PRIu64 " ns p99.99=%10" PRIu64 " ns max=%10" PRIu64 " ns\n",count,
+        percentile(0.5),percentile(0.99),percentile(0.999),percentile(0.9999),all.back());
+}
+
+int main()
+{
+    littlelog::init("/tmp/","stress",64);
+    for(int count:{1,2,4,8,16})
+    {
+        benchmark(count);
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    return 0;
+}
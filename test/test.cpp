@@ -1,9 +1,24 @@
 #include <iostream>
 #include "LittleLog.hpp"
+#include <fstream>
+#include <string>
 #include <vector>
 #include <chrono>
 #include <thread>
 
+struct Price
+{
+    int64_t mantissa;
+    int32_t exponent;
+};
+
+std::ostream& operator<<(std::ostream& os,const Price& p)
+{
+    return os<<p.mantissa<<'e'<<p.exponent;
+}
+
+LITTLELOG_CODEC(Price)
+
 void work()
 {
     const int cnt=100;
@@ -14,6 +29,7 @@ void work()
 	std::string s = { 'a' };
     LOG_INFO<<s;
 	LOG_INFO <<"abckso"<<9<<'k'<<5679812;
+    LOG_INFO <<"price "<<Price{12345,-2};
     uint64_t end = std::chrono::steady_clock::now().time_since_epoch() / std::chrono::microseconds(1);
     long int avg_latency = (end - start) * 100 / cnt;
     printf("\tAverage LittleLog Latency = %ld nanoseconds\n", avg_latency);
@@ -27,9 +43,101 @@ void benchmark(Fun&& f,int count)
     for(int i=0;i<count;i++)threads[i].join();
 }
 
+void rate_limit()
+{
+    for(int i=0;i<100000;i++)
+    {
+        LOG_EVERY_N(INFO,10000)<<"every_n "<<i;
+        LOG_FIRST_N(INFO,3)<<"first_n "<<i;
+        LOG_EVERY_MS(INFO,1000)<<"every_ms "<<i;
+        LOG_RATE_LIMITED(INFO,10,5)<<"rate_limited "<<i;
+    }
+}
+
+void trace()
+{
+    LOG_SCOPE("trace");
+    for(int i=0;i<10;i++)
+    {
+        LOG_SCOPE("iteration");
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+void duplicate()
+{
+    for(int i=0;i<100000;i++)
+    {
+        LOG_INFO<<"duplicate "<<42<<' '<<Price{100,-2};
+        if(i%10000==0)
+            LOG_WARN<<"duplicate run "<<i;
+    }
+}
+
+//飞行记录器容量1MB：先写满使环回绕，再写超过半个环和接近半个环的大日志，由WARN触发写出；
+//之后再写一条超过半个环的日志并手动dump，被接受的话它会出现在dump的结果中
+void flight()
+{
+    for(int i=0;i<30000;i++)
+        LOG_INFO<<"flight "<<i;
+    LOG_INFO<<std::string(600*1024,'r');
+    LOG_INFO<<std::string(300*1024,'a');
+    LOG_WARN<<"flight trigger";
+    for(int i=30000;i<30100;i++)
+        LOG_INFO<<"flight "<<i;
+    LOG_INFO<<std::string(800*1024,'r');
+    littlelog::dump();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+/**
+ * @brief 检查flight()写出的文件：超过半个环的日志被丢弃，300KB的日志保留；WARN触发的写出中flight N连续、
+ *        起点大于0(环已回绕)，紧接着300KB的日志和触发日志；之后手动dump写出30000~30099
+ *
+ */
+int check_flight(const std::string& path)
+{
+    std::ifstream in(path);
+    std::string line;
+    std::vector<int> expected,actual;
+    const int oversized=-1,large=-2,trigger=-3;
+    while(std::getline(in,line))
+    {
+        size_t pos=0;
+        for(int i=0;i<4&&pos!=std::string::npos;i++)
+            pos=line.find(']',pos+(i>0));
+        if(pos==std::string::npos)continue;
+        std::string payload=line.substr(pos+1);
+        if(payload.compare(0,7,"flight ")==0)
+            actual.push_back(payload=="flight trigger"?trigger:std::stoi(payload.substr(7)));
+        else if(payload.size()==300*1024&&payload.find_first_not_of('a')==std::string::npos)
+            actual.push_back(large);
+        else if(payload.compare(0,3,"rrr")==0)
+            actual.push_back(oversized);
+    }
+    int first=actual.empty()?0:actual[0];
+    if(first>0)
+    {
+        for(int i=first;i<30000;i++)expected.push_back(i);
+        expected.push_back(large);
+        expected.push_back(trigger);
+        for(int i=30000;i<30100;i++)expected.push_back(i);
+    }
+    bool ok=first>0&&actual==expected;
+    printf("\tflight recorder: %zu lines from flight %d, %s\n",actual.size(),first,ok?"ok":"unexpected");
+    return ok?0:1;
+}
+
 int main()
 {
     littlelog::init("/tmp/","log",1);
+    littlelog::init_trace("/tmp/trace.json");
     benchmark(work,5);
-    return 0;
+    benchmark(rate_limit,2);
+    benchmark(trace,2);
+    littlelog::set_collapse_duplicates(100);
+    benchmark(duplicate,2);
+    littlelog::init_flight_recorder("/tmp/","flight",64,1);
+    benchmark(flight,1);
+    return check_flight("/tmp/flight.0.txt");
 }
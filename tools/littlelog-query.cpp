@@ -0,0 +1,255 @@
+#include "Write_to_file.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <fstream>
+
+/**
+ * @brief 利用write_to_file生成的稀疏索引查询日志文件：
+ *        littlelog-query [-j 线程数] [--from 时间] [--to 时间] [--level INFO,WARN,DEBUG] /tmp/log
+ *        时间格式为"YYYY-MM-DD HH:MM:SS[.uuuuuu]"(UTC，与日志一致)或微秒时间戳；
+ *        索引命中的块通过mmap直接定位，多个文件由多个线程并行扫描，结果按文件编号顺序输出
+ *
+ */
+
+struct Query
+{
+    uint64_t from=0;
+    uint64_t to=UINT64_MAX;
+    uint32_t levels=~0u;
+};
+
+struct LogFile
+{
+    uint32_t number;
+    std::string path;
+};
+
+static const char* const level_names[]={"INFO","WARN","DEBUG"};
+
+static void usage()
+{
+    fprintf(stderr,"usage: littlelog-query [-j threads] [--from time] [--to time] [--level INFO,WARN,DEBUG] <dir/file>\n");
+    exit(1);
+}
+
+/**
+ * @brief 解析"YYYY-MM-DD HH:MM:SS"格式的时间，返回秒
+ *
+ */
+static bool parse_seconds(const char* s,size_t len,uint64_t& seconds)
+{
+    if(len<19||s[4]!='-'||s[7]!='-'||s[10]!=' '||s[13]!=':'||s[16]!=':')return false;
+    struct tm t{};
+    auto num=[s](int pos,int n){int v=0;for(int i=0;i<n;i++)v=v*10+(s[pos+i]-'0');return v;};
+    t.tm_year=num(0,4)-1900;
+    t.tm_mon=num(5,2)-1;
+    t.tm_mday=num(8,2);
+    t.tm_hour=num(11,2);
+    t.tm_min=num(14,2);
+    t.tm_sec=num(17,2);
+    seconds=static_cast<uint64_t>(timegm(&t));
+    return true;
+}
+
+static uint64_t parse_time_arg(const char* s)
+{
+    size_t len=strlen(s);
+    uint64_t seconds;
+    if(!parse_seconds(s,len,seconds))
+        return strtoull(s,nullptr,10);
+    uint64_t micros=0;
+    if(len>20&&s[19]=='.')
+    {
+        int digits=0;
+        for(size_t i=20;i<len&&digits<6;i++,digits++)micros=micros*10+(s[i]-'0');
+        for(;digits<6;digits++)micros*=10;
+    }
+    return seconds*1000000+micros;
+}
+
+static uint32_t parse_levels(const char* s)
+{
+    uint32_t mask=0;
+    std::string arg(s);
+    size_t start=0;
+    while(start<=arg.size())
+    {
+        size_t end=arg.find(',',start);
+        if(end==std::string::npos)end=arg.size();
+        std::string name=arg.substr(start,end-start);
+        for(uint32_t i=0;i<sizeof(level_names)/sizeof(level_names[0]);i++)
+            if(name==level_names[i])mask|=1u<<i;
+        start=end+1;
+    }
+    return mask;
+}
+
+/**
+ * @brief 解析日志行头部"[YYYY-MM-DD HH:MM:SS.uuuuuu][LEVEL]"，同一秒内的行复用上次的timegm结果
+ *
+ */
+class LineParser
+{
+public:
+    bool parse(const char* b,const char* end,uint64_t& t,uint32_t& level)
+    {
+        if(end-b<30||b[0]!='['||b[20]!='.'||b[27]!=']'||b[28]!='[')return false;
+        if(memcmp(cached,b+1,19)!=0)
+        {
+            if(!parse_seconds(b+1,19,cached_seconds))return false;
+            memcpy(cached,b+1,19);
+        }
+        uint64_t micros=0;
+        for(int i=21;i<27;i++)micros=micros*10+(b[i]-'0');
+        t=cached_seconds*1000000+micros;
+        const char* name=b+29;
+        for(level=0;level<sizeof(level_names)/sizeof(level_names[0]);level++)
+        {
+            size_t n=strlen(level_names[level]);
+            if(end-name>static_cast<long>(n)&&memcmp(name,level_names[level],n)==0&&name[n]==']')
+                return true;
+        }
+        return false;
+    }
+private:
+    char cached[19]={};
+    uint64_t cached_seconds=0;
+};
+
+static void scan_range(const char* b,const char* end,const Query& q,std::string& out)
+{
+    LineParser parser;
+    bool match=false;
+    while(b<end)
+    {
+        const char* eol=static_cast<const char*>(memchr(b,'\n',end-b));
+        const char* next=eol?eol+1:end;
+        uint64_t t;
+        uint32_t level;
+        //无法解析头部的行属于上一条日志(日志内容中含有换行)
+        if(parser.parse(b,next,t,level))
+            match=t>=q.from&&t<=q.to&&(q.levels&(1u<<level));
+        if(match)out.append(b,next-b);
+        b=next;
+    }
+}
+
+static std::vector<littlelog::IndexEntry> read_index(const std::string& path)
+{
+    std::vector<littlelog::IndexEntry> entries;
+    std::ifstream is(path,std::ifstream::binary);
+    char magic[sizeof(littlelog::index_magic)];
+    if(!is.read(magic,sizeof(magic))||memcmp(magic,littlelog::index_magic,sizeof(magic))!=0)
+        return entries;
+    littlelog::IndexEntry e;
+    while(is.read(reinterpret_cast<char*>(&e),sizeof(e)))
+        entries.push_back(e);
+    return entries;
+}
+
+static void query_file(const LogFile& f,const Query& q,std::string& out)
+{
+    int fd=open(f.path.c_str(),O_RDONLY);
+    if(fd<0)return;
+    struct stat st;
+    if(fstat(fd,&st)!=0||st.st_size==0)
+    {
+        close(fd);
+        return;
+    }
+    size_t size=st.st_size;
+    void* p=mmap(nullptr,size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if(p==MAP_FAILED)return;
+    const char* base=static_cast<const char*>(p);
+
+    std::vector<littlelog::IndexEntry> entries=read_index(f.path+".idx");
+    uint64_t indexed=0;
+    for(const littlelog::IndexEntry& e:entries)
+    {
+        if(e.offset+e.length>size)break;
+        indexed=e.offset+e.length;
+        if(e.max_time<q.from||e.min_time>q.to||!(e.levels&q.levels))continue;
+        madvise(const_cast<char*>(base)+(e.offset&~static_cast<uint64_t>(4095)),e.length+(e.offset&4095),MADV_SEQUENTIAL);
+        scan_range(base+e.offset,base+e.offset+e.length,q,out);
+    }
+    //尚未写入索引的尾部(最后一个块或没有索引的文件)需要完整扫描
+    if(indexed<size)
+        scan_range(base+indexed,base+size,q,out);
+    munmap(p,size);
+}
+
+/**
+ * @brief 找出目录下所有"file.N.txt"形式的日志文件，按N排序
+ *
+ */
+static std::vector<LogFile> list_files(const std::string& prefix)
+{
+    std::vector<LogFile> files;
+    size_t slash=prefix.rfind('/');
+    std::string dir=slash==std::string::npos?".":prefix.substr(0,slash+1);
+    std::string base=slash==std::string::npos?prefix:prefix.substr(slash+1);
+    DIR* d=opendir(dir.c_str());
+    if(!d)return files;
+    while(dirent* ent=readdir(d))
+    {
+        std::string name=ent->d_name;
+        if(name.size()<=base.size()+5||name.compare(0,base.size()+1,base+".")!=0)continue;
+        if(name.compare(name.size()-4,4,".txt")!=0)continue;
+        std::string number=name.substr(base.size()+1,name.size()-base.size()-5);
+        if(number.empty()||number.find_first_not_of("0123456789")!=std::string::npos)continue;
+        std::string path=dir=="."&&slash==std::string::npos?name:dir+name;
+        files.push_back(LogFile{static_cast<uint32_t>(std::stoul(number)),path});
+    }
+    closedir(d);
+    std::sort(files.begin(),files.end(),[](const LogFile& a,const LogFile& b){return a.number<b.number;});
+    return files;
+}
+
+int main(int argc,char** argv)
+{
+    Query q;
+    unsigned int threads=std::max(1u,std::thread::hardware_concurrency());
+    const char* prefix=nullptr;
+    for(int i=1;i<argc;i++)
+    {
+        std::string arg=argv[i];
+        if(arg=="-j"&&i+1<argc)threads=std::max(1,atoi(argv[++i]));
+        else if(arg=="--from"&&i+1<argc)q.from=parse_time_arg(argv[++i]);
+        else if(arg=="--to"&&i+1<argc)q.to=parse_time_arg(argv[++i]);
+        else if(arg=="--level"&&i+1<argc)q.levels=parse_levels(argv[++i]);
+        else if(arg[0]!='-'&&!prefix)prefix=argv[i];
+        else usage();
+    }
+    if(!prefix)usage();
+
+    std::vector<LogFile> files=list_files(prefix);
+    std::vector<std::string> results(files.size());
+    std::atomic<size_t> next(0);
+    auto worker=[&]()
+    {
+        for(size_t i=next.fetch_add(1);i<files.size();i=next.fetch_add(1))
+            query_file(files[i],q,results[i]);
+    };
+    std::vector<std::thread> pool;
+    for(unsigned int i=1;i<std::min<size_t>(threads,files.size());i++)
+        pool.emplace_back(worker);
+    worker();
+    for(std::thread& t:pool)t.join();
+
+    for(const std::string& r:results)
+        fwrite(r.data(),1,r.size(),stdout);
+    return 0;
+}
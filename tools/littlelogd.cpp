@@ -0,0 +1,101 @@
+#include "ShmRing.hpp"
+#include "Write_to_file.hpp"
+#include <signal.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <stdexcept>
+
+/**
+ * @brief 进程外日志后端：littlelogd [--size MB] [--roll MB] [--collapse MS] <共享内存名> <目录/> <文件名>
+ *        读取应用进程通过littlelog::init_shared写入共享内存的日志，格式化后写入dir+file.N.txt；
+ *        应用进程退出或崩溃后仍会把环中已提交的日志写完。收到SIGINT/SIGTERM后写完剩余日志再退出
+ *
+ */
+
+static std::atomic<bool> running(true);
+
+static void on_signal(int)
+{
+    running.store(false);
+}
+
+static void usage()
+{
+    fprintf(stderr,"usage: littlelogd [--size MB] [--roll MB] [--collapse MS] <shm-name> <dir/> <file>\n");
+    exit(1);
+}
+
+static void report_dropped(littlelog::ShmRing& ring,littlelog::write_to_file& writer)
+{
+    uint64_t n=ring.take_dropped();
+    if(!n)return;
+    littlelog::LogLine lg(littlelog::LogLevel::WARN,"littlelogd","drain",0);
+    lg<<"dropped "<<n<<" log lines, shared memory ring was full";
+    writer.write(lg);
+}
+
+int main(int argc,char** argv)
+{
+    uint32_t size_mb=64;
+    uint32_t roll_mb=64;
+    uint32_t collapse_ms=0;
+    std::vector<const char*> args;
+    for(int i=1;i<argc;i++)
+    {
+        std::string arg=argv[i];
+        if(arg=="--size"&&i+1<argc)size_mb=atoi(argv[++i]);
+        else if(arg=="--roll"&&i+1<argc)roll_mb=atoi(argv[++i]);
+        else if(arg=="--collapse"&&i+1<argc)collapse_ms=atoi(argv[++i]);
+        else if(arg[0]!='-')args.push_back(argv[i]);
+        else usage();
+    }
+    if(args.size()!=3||!size_mb||!roll_mb)usage();
+
+    signal(SIGINT,on_signal);
+    signal(SIGTERM,on_signal);
+
+    std::unique_ptr<littlelog::ShmRing> ring;
+    try
+    {
+        ring.reset(new littlelog::ShmRing(args[0],size_mb));
+    }
+    catch(const std::exception& e)
+    {
+        fprintf(stderr,"littlelogd: %s\n",e.what());
+        return 1;
+    }
+
+    littlelog::write_to_file writer(args[1],args[2],roll_mb);
+    writer.set_collapse_window(static_cast<uint64_t>(collapse_ms)*1000);
+    littlelog::LogLine curLog(littlelog::LogLevel::INFO,nullptr,nullptr,0);
+    auto last_report=std::chrono::steady_clock::now();
+    while(running.load())
+    {
+        if(ring->try_peek(curLog))
+        {
+            writer.write(curLog);
+            ring->pop();
+            continue;
+        }
+        if(std::chrono::steady_clock::now()-last_report>=std::chrono::seconds(1))
+        {
+            report_dropped(*ring,writer);
+            last_report=std::chrono::steady_clock::now();
+        }
+        writer.tick(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    while(ring->try_peek(curLog))
+    {
+        writer.write(curLog);
+        ring->pop();
+    }
+    report_dropped(*ring,writer);
+    return 0;
+}